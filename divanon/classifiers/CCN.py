@@ -17,25 +17,27 @@
 #
 
 # from divanon.vendor.cascade_net import CascadeNet, logistic, d_logistic
-from divanon.dblink.cmu_wrapper import CMUWrapper
+from divanon.dblink.cmu_wrapper import CASCOR_CFG, BIN_POS, BIN_NEG
+from divanon.dblink.cascor_lib import CascorNet
 import numpy as np
 
 
 class CCN:
     def __init__(self, name: str, verbose=True):
         self.filename = name
-        self.full_filename = name + '.data'
-        self.classifier = CMUWrapper()
         self.verbose = verbose
+        self.net = None
 
     def train(self, X, y):
-        self.classifier.generateTrainSet(
-            self.full_filename, X, y, np.max(y) + 1
-        )
+        # one node per class, the way cascor expands 'ENUM {0,1,...}' outputs
+        Y = np.full((len(y), np.max(y) + 1), BIN_NEG, dtype=np.float32)
+        Y[np.arange(len(y)), np.asarray(y, dtype=int)] = BIN_POS
+
+        # the network is trained in this process, straight on the arrays
+        self.net = CascorNet(self.verbose)
+        self.net.loadConfig(CASCOR_CFG)
+        self.net.setData(X, Y)
+        self.net.train()
 
     def estimate(self, X):
-        return self.classifier.estimateByTrainFile(
-            self.full_filename,
-            X,
-            self.verbose
-        )
+        return self.net.predict(X).argmax(axis=1)
@@ -0,0 +1,87 @@
+#
+#    divanon: the deanonymizer
+#    Copyright (C) 2018  Bohdan "bodqhrohro" Horbeshko
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import socket
+import struct
+import numpy as np
+
+# message layout, see vendor/cascor/v110/server.c
+REQUEST = struct.Struct('=2i')
+REPLY = struct.Struct('=4i')
+SERVE_OK = 0
+SERVE_BAD_NET = 1
+SERVE_TOO_BIG = 2
+SERVE_NO_MEMORY = 3
+REFUSALS = {
+    SERVE_BAD_NET: "no such network",
+    SERVE_TOO_BIG: "too many points",
+    SERVE_NO_MEMORY: "out of memory",
+}
+
+
+class CascorClient:
+    # talks to a 'cascor -S <socket> ...' server; one client per thread, the
+    # server runs the requests of all its clients together
+    def __init__(self, path: str):
+        self.sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        self.sock.connect(path)
+
+    def __del__(self):
+        self.close()
+
+    def close(self):
+        if getattr(self, 'sock', None):
+            self.sock.close()
+            self.sock = None
+
+    def _recv(self, n: int) -> bytes:
+        data = bytearray()
+        while len(data) < n:
+            chunk = self.sock.recv(n - len(data))
+            if not chunk:
+                raise ConnectionError("cascor server hung up")
+            data += chunk
+        return bytes(data)
+
+    def _request(self, net: int, X: np.array):
+        try:
+            self.sock.sendall(REQUEST.pack(net, len(X)) + X.tobytes())
+        except (BrokenPipeError, ConnectionResetError):
+            # a refused request is answered before its points are read,
+            # so the reply may still be waiting
+            pass
+        status, inputs, outputs, pts = REPLY.unpack(self._recv(REPLY.size))
+        if status != SERVE_OK:
+            self.close()
+            raise ValueError(
+                "cascor server refused the request: "
+                + REFUSALS.get(status, "status %d" % status)
+            )
+        return inputs, outputs, pts
+
+    def sizes(self, net: int = 0) -> tuple:
+        # (inputs, outputs) of the network
+        inputs, outputs, _ = self._request(net, np.zeros(0, np.float32))
+        return inputs, outputs
+
+    def predict(self, X: np.array, net: int = 0) -> np.array:
+        X = np.ascontiguousarray(X, np.float32)
+        _, outputs, pts = self._request(net, X)
+        return np.frombuffer(
+            self._recv(4 * pts * outputs), np.float32
+        ).reshape(pts, outputs)
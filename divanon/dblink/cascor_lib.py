@@ -0,0 +1,150 @@
+#
+#    divanon: the deanonymizer
+#    Copyright (C) 2018  Bohdan "bodqhrohro" Horbeshko
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+import ctypes
+import numpy as np
+
+CASCOR_LIB = './vendor/cascor/v110/libcascor.so'
+
+# data sets of cascor_set_data(), see vendor/cascor/v110/cascor.h
+TRAIN_SET = 0
+VALIDATE_SET = 1
+TEST_SET = 2
+
+_c_float_p = ctypes.POINTER(ctypes.c_float)
+_lib = None
+
+
+def _loadLib() -> ctypes.CDLL:
+    global _lib
+    if _lib is not None:
+        return _lib
+
+    lib = ctypes.CDLL(CASCOR_LIB)
+    lib.cascor_new.restype = ctypes.c_void_p
+    lib.cascor_new.argtypes = []
+    lib.cascor_set_verbose.restype = None
+    lib.cascor_set_verbose.argtypes = [ctypes.c_void_p, ctypes.c_int]
+    lib.cascor_set_parm.restype = ctypes.c_int
+    lib.cascor_set_parm.argtypes = [
+        ctypes.c_void_p, ctypes.c_char_p, ctypes.c_char_p
+    ]
+    lib.cascor_load_config.restype = ctypes.c_int
+    lib.cascor_load_config.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.cascor_set_data.restype = ctypes.c_int
+    lib.cascor_set_data.argtypes = [
+        ctypes.c_void_p, ctypes.c_int, _c_float_p, _c_float_p,
+        ctypes.c_int, ctypes.c_int, ctypes.c_int
+    ]
+    lib.cascor_train.restype = ctypes.c_int
+    lib.cascor_train.argtypes = [ctypes.c_void_p]
+    lib.cascor_load_net.restype = ctypes.c_int
+    lib.cascor_load_net.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.cascor_continue.restype = ctypes.c_int
+    lib.cascor_continue.argtypes = [ctypes.c_void_p, ctypes.c_char_p]
+    lib.cascor_predict.restype = ctypes.c_int
+    lib.cascor_predict.argtypes = [
+        ctypes.c_void_p, _c_float_p, ctypes.c_int, _c_float_p
+    ]
+    lib.cascor_free.restype = None
+    lib.cascor_free.argtypes = [ctypes.c_void_p]
+
+    _lib = lib
+    return lib
+
+
+def _floatPtr(a: np.array):
+    return a.ctypes.data_as(_c_float_p)
+
+
+class CascorNet:
+    # one network inside the cascor library; several can live side by side
+    def __init__(self, verbose: bool = False):
+        self.lib = _loadLib()
+        self.cc = self.lib.cascor_new()
+        self.lib.cascor_set_verbose(self.cc, int(verbose))
+        # the library reads the data sets straight out of these arrays, so
+        # they have to be kept alive for as long as the network is
+        self.sets = {}
+        self.inputs = 0
+        self.outputs = 0
+
+    def __del__(self):
+        self.free()
+
+    def free(self):
+        if getattr(self, 'cc', None):
+            self.lib.cascor_free(self.cc)
+            self.cc = None
+            self.sets = {}
+
+    def loadConfig(self, filename: str):
+        if not self.lib.cascor_load_config(self.cc, filename.encode()):
+            raise ValueError("Can't read config " + filename)
+
+    def setParm(self, name: str, value):
+        if not self.lib.cascor_set_parm(
+            self.cc, name.encode(), str(value).encode()
+        ):
+            raise ValueError("Can't set " + name)
+
+    def setData(self, X: np.array, Y: np.array, dataSet: int = TRAIN_SET):
+        # arrays that already are float32 and C-ordered are not copied
+        X = np.ascontiguousarray(X, np.float32)
+        Y = np.ascontiguousarray(Y, np.float32)
+        if not self.lib.cascor_set_data(
+            self.cc, dataSet, _floatPtr(X), _floatPtr(Y),
+            X.shape[0], X.shape[1], Y.shape[1]
+        ):
+            raise ValueError("Data set rejected")
+        if dataSet == TRAIN_SET:
+            self.sets = {}
+            self.inputs = X.shape[1]
+            self.outputs = Y.shape[1]
+        self.sets[dataSet] = (X, Y)
+
+    def train(self):
+        if not self.lib.cascor_train(self.cc):
+            raise RuntimeError("Training failed")
+
+    def loadNet(self, filename: str):
+        if not self.lib.cascor_load_net(self.cc, filename.encode()):
+            raise ValueError("Can't load network " + filename)
+
+    def continueTraining(self, filename: str):
+        # carries on training a saved network on the current data, which
+        # should be the data it was trained on with new patterns appended
+        if not self.lib.cascor_continue(self.cc, filename.encode()):
+            raise ValueError("Can't load network " + filename)
+
+    def predict(self, X: np.array) -> np.array:
+        X = np.ascontiguousarray(X, np.float32)
+        # the library takes the row length on trust
+        if X.ndim != 2 or X.shape[1] != self.inputs:
+            raise ValueError(
+                "Expected rows of %d inputs, got shape %s"
+                % (self.inputs, X.shape)
+            )
+        if not len(X):
+            return np.empty((0, self.outputs), np.float32)
+        result = np.empty((len(X), self.outputs), np.float32)
+        if not self.lib.cascor_predict(
+            self.cc, _floatPtr(X), len(X), _floatPtr(result)
+        ):
+            raise RuntimeError("Network is not trained, or out of memory")
+        return result
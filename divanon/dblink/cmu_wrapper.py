@@ -19,22 +19,90 @@
 import numpy as np
 import tempfile
 import subprocess
-import shlex
+import struct
 import os
 import re
 
+CASCOR_BIN = './vendor/cascor/v110/cascor'
+CASCOR_CFG = './vendor/cascor/v110/cascor.cfg'
+
+# binary data file layout, see write_binary() in vendor/cascor/v110/parse.c
+BIN_MAGIC = b'CMUBIN1\0'
+BIN_ORDER = 0x01020304
+BIN_ALIGN = 64
+BIN_HEADER = struct.Struct('=8s11i')
+PROTOCOL_IO = 1
+OUT_BINARY = 1
+# values of the output nodes of an unary enumeration, as the parser makes them
+BIN_POS = 0.5
+BIN_NEG = -0.5
+
+
+def _binRound(n: int) -> int:
+    return (n + BIN_ALIGN - 1) // BIN_ALIGN * BIN_ALIGN
 
-class CMUWrapper:
-    def _writeLine(self, line: str):
-        self.hFile.write(line + '\n')
 
-    def _writeDataLine(self, xs: np.array, y: np.array):
-        self._writeLine(
-            ', '.join(map(lambda n: '{:.10f}'.format(n), xs)) + ' => ' +
-            str(y) + ';')
+def _cacheFile(netfile: str) -> str:
+    # the cache cascor saves next to a network, see cache_file() in
+    # vendor/cascor/v110/cascor.c
+    base = netfile[:-len('.net')] if netfile.endswith('.net') else netfile
+    return base + '.cache'
 
-    def _writeKeyVal(self, key: str, val):
-        self.hFile.write(key + ': ' + str(val) + ';\n')
+
+class CMUWrapper:
+    def _encodeOutputs(self, y: np.array, num_ys: int) -> np.array:
+        # one node per class, the way cascor expands 'ENUM {0,1,...}' outputs
+        Y = np.full((len(y), num_ys), BIN_NEG, dtype=np.float32)
+        Y[np.arange(len(y)), np.asarray(y, dtype=int)] = BIN_POS
+        return Y
+
+    def _writeBinary(self, hFile, sets: list):
+        # sets are (inputs, outputs) pairs for the train, validation and test
+        # sets; empty ones are None
+        sets = [
+            (np.zeros((0, 0), np.float32),) * 2 if s is None else
+            (np.ascontiguousarray(s[0], np.float32),
+             np.ascontiguousarray(s[1], np.float32))
+            for s in sets
+        ]
+        inputs = next(s[0].shape[1] for s in sets if len(s[0]))
+        outputs = next(s[1].shape[1] for s in sets if len(s[1]))
+        pts = [len(s[0]) for s in sets]
+
+        def padTo(at: int):
+            hFile.write(b'\0' * (at - hFile.tell()))
+
+        hFile.write(BIN_HEADER.pack(
+            BIN_MAGIC, BIN_ORDER, PROTOCOL_IO, 0, inputs, outputs,
+            *pts, 0, 0, 0
+        ))
+        hFile.write(np.full(outputs, OUT_BINARY, np.int32).tobytes())
+
+        for X, Y in sets:
+            # no segment markers in IO data
+            padTo(_binRound(hFile.tell()))
+            hFile.write(b'\0' * len(X))
+            padTo(_binRound(hFile.tell()))
+            hFile.write(X.tobytes())
+            padTo(_binRound(hFile.tell()))
+            hFile.write(Y.tobytes())
+        padTo(_binRound(hFile.tell()))
+
+    def _readTrainSet(self, filename: str):
+        with open(filename, 'rb') as hFile:
+            header = BIN_HEADER.unpack(hFile.read(BIN_HEADER.size))
+            inputs, outputs, train_pts = header[4], header[5], header[6]
+            at = _binRound(BIN_HEADER.size + 4 * outputs)
+            at = _binRound(at + train_pts)
+            X = np.fromfile(
+                hFile, np.float32, train_pts * inputs, offset=at - hFile.tell()
+            )
+            at = _binRound(at + 4 * train_pts * inputs)
+            Y = np.fromfile(
+                hFile, np.float32, train_pts * outputs,
+                offset=at - hFile.tell()
+            )
+        return X.reshape(train_pts, inputs), Y.reshape(train_pts, outputs)
 
     def generateTrainSet(
         self, filename: str, X: np.array, y: np.array, num_ys: int
@@ -42,69 +110,144 @@ class CMUWrapper:
         if not len(X) or not len(y):
             return
 
+        # cascor maps binary data files straight into memory, which saves
+        # both formatting the text here and parsing it back there
         try:
-            self.hFile = open(filename, 'w')
-
-            self._writeLine('$SETUP')
-            self._writeKeyVal('PROTOCOL', 'IO')
-            self._writeKeyVal('OFFSET', 0)
-            self._writeKeyVal('INPUTS', len(X[0]))
-            self._writeKeyVal('OUTPUTS', 1)
-            for i, _ in enumerate(X[0]):
-                self._writeKeyVal('IN [' + str(i + 1) + ']', 'CONT {0..1}')
-            self._writeKeyVal('OUT [1]', 'ENUM {' + ",".join([
-                str(i) for i in range(num_ys)
-            ]) + '}')
-
-            self._writeLine('$TRAIN')
+            with open(filename, 'wb') as hFile:
+                self._writeBinary(
+                    hFile, [(X, self._encodeOutputs(y, num_ys)), None, None]
+                )
+        except OSError:
+            print("Can't write dataset!")
 
-            for i, X_r in enumerate(X):
-                self._writeDataLine(X_r, y[i])
+    def appendTrainSet(
+        self, filename: str, X: np.array, y: np.array, num_ys: int
+    ):
+        # new posts go after the ones already there, so that a network
+        # trained on the file can carry on with continueByTrainFile
+        if not len(X) or not len(y):
+            return
+        if not os.path.exists(filename):
+            return self.generateTrainSet(filename, X, y, num_ys)
 
-            self.hFile.close()
+        X_train, Y_train = self._readTrainSet(filename)
+        try:
+            with open(filename, 'wb') as hFile:
+                self._writeBinary(hFile, [(
+                    np.concatenate((X_train, X)),
+                    np.concatenate((Y_train, self._encodeOutputs(y, num_ys)))
+                ), None, None])
         except OSError:
             print("Can't write dataset!")
 
-        self.hFile = None
+    def _runCascor(self, args: list, verbose: bool, saveCache: bool = False):
+        # cascor takes a single configuration file, so saving the cache,
+        # which is off in the shipped one, means running on a copy of it
+        config = CASCOR_CFG
+        if saveCache:
+            with open(CASCOR_CFG, 'r') as hCfg, tempfile.NamedTemporaryFile(
+                mode='w', suffix='.cfg', delete=False
+            ) as hFile:
+                hFile.write(hCfg.read() + '\nsaveCache\tTrue\n')
+            config = hFile.name
+        try:
+            subprocess.run(
+                [CASCOR_BIN] + args + [config],
+                stdout=None if verbose else subprocess.DEVNULL,
+                stderr=subprocess.STDOUT
+            )
+        finally:
+            if saveCache:
+                os.remove(config)
+
+    def trainByTrainFile(self, filename: str, netname: str, verbose: bool):
+        # cascor appends the trial number to the name of the weight file;
+        # a stale network or cache from an earlier run must not be left
+        # behind if this one fails
+        netfile = netname + '-1.net'
+        for name in (netfile, _cacheFile(netfile)):
+            try:
+                os.remove(name)
+            except FileNotFoundError:
+                pass
+
+        self._runCascor(['-s', netname, filename], verbose, saveCache=True)
+
+        return netfile if os.path.exists(netfile) else None
+
+    def continueByTrainFile(
+        self, filename: str, netfile: str, netname: str, verbose: bool
+    ):
+        # carries on training netfile on a training set that has had posts
+        # appended since; the cache saved with it spares recomputing the
+        # hidden units on the old ones.  netname may be netfile's own name
+        outfile = netname + '-1.net'
+        prev = netfile
+        if os.path.abspath(outfile) == os.path.abspath(netfile):
+            prev = netname + '-1.prev.net'
+            os.replace(netfile, prev)
+            if os.path.exists(_cacheFile(netfile)):
+                os.replace(_cacheFile(netfile), _cacheFile(prev))
+        else:
+            for name in (outfile, _cacheFile(outfile)):
+                try:
+                    os.remove(name)
+                except FileNotFoundError:
+                    pass
+
+        self._runCascor(
+            ['-C', prev, '-s', netname, filename], verbose, saveCache=True
+        )
 
-    def estimateByTrainFile(self, filename: str, X: np.array, verbose: bool):
+        if prev != netfile:
+            # the old network goes back if no new one came out
+            restore = not os.path.exists(outfile)
+            for old, new in ((prev, netfile),
+                             (_cacheFile(prev), _cacheFile(netfile))):
+                if os.path.exists(old):
+                    if restore:
+                        os.replace(old, new)
+                    else:
+                        os.remove(old)
+
+        return outfile if os.path.exists(outfile) else None
+
+    def estimateByTrainFile(
+        self, filename: str, X: np.array, verbose: bool, netfile: str = None
+    ):
+        X_train, Y_train = self._readTrainSet(filename)
         self.hFile = tempfile.NamedTemporaryFile(
-            mode='w',
+            mode='wb',
             suffix='.data',
             delete=False
         )
-        stableFile = open(filename, 'r')
-        self.hFile.write(stableFile.read())
-        stableFile.close()
-
-        self._writeLine('$TEST')
-        for i, X_r in enumerate(X):
-            self._writeDataLine(X_r, 0)
-
+        # the test set goals are dummies, the actual outputs are what counts
+        self._writeBinary(self.hFile, [
+            (X_train, Y_train), None,
+            (X, self._encodeOutputs(np.zeros(len(X)), Y_train.shape[1]))
+        ])
         self.hFile.close()
-
-        try:
-            os.remove('test.results')
-        except FileNotFoundError:
-            pass
-        subprocess.run(
-            [
-                './vendor/cascor/v110/cascor', shlex.quote(self.hFile.name),
-                './vendor/cascor/v110/cascor.cfg'
-            ],
-            stdout=None if verbose else open(os.devnull, 'w'),
-            stderr=subprocess.STDOUT
+        # a results file of its own, so that concurrent callers don't write
+        # over each other's outputs
+        results = self.hFile.name[:-len('.data')] + '.results'
+
+        # with a trained network at hand, only the forward passes over the
+        # test set are needed; otherwise train it again from scratch
+        self._runCascor(
+            (['-p', netfile] if netfile else []) +
+            ['-r', results, self.hFile.name],
+            verbose
         )
 
         os.remove(self.hFile.name)
 
-        # now read the cascor's hardcoded output file
-        self.hFile = open('test.results', 'r')
+        self.hFile = open(results, 'r')
         result = np.array([
             np.array(re.findall(r'\((-?[\d]+\.[\d]+)\)', line)).argmax()
             for line in self.hFile.readlines()
         ])
         self.hFile.close()
         self.hFile = None
+        os.remove(results)
 
         return result
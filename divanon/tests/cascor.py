@@ -0,0 +1,720 @@
+#!/usr/bin/env python
+#
+#    divanon: the deanonymizer
+#    Copyright (C) 2018  Bohdan "bodqhrohro" Horbeshko
+#
+#    This program is free software: you can redistribute it and/or modify
+#    it under the terms of the GNU General Public License as published by
+#    the Free Software Foundation, either version 3 of the License, or
+#    (at your option) any later version.
+#
+#    This program is distributed in the hope that it will be useful,
+#    but WITHOUT ANY WARRANTY; without even the implied warranty of
+#    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+#    GNU General Public License for more details.
+#
+#    You should have received a copy of the GNU General Public License
+#    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+#
+
+
+import unittest
+import csv, json, os, re, shutil, socket, struct, subprocess, tempfile
+import threading, time
+import numpy as np
+
+# built by 'make' in vendor/cascor/v110, the benchmark by 'make benchmark';
+# paths are from divanon/, where 'make test' runs
+CASCOR_DIR = 'vendor/cascor/v110'
+CASCOR_BIN = CASCOR_DIR + '/cascor'
+CMU2BIN_BIN = CASCOR_DIR + '/cmu2bin'
+CASCOR_LIB = CASCOR_DIR + '/libcascor.so'
+BENCH_BIN = CASCOR_DIR + '/benchmark'
+
+TRAIN_CFG = 'seed\t7\nmaxNewUnits\t3\ntest\tTrue\n'
+
+
+def makeSet(n: int, inputs: int = 8, outputs: int = 2, seed: int = 7):
+    # points in [-1, 1] with binary outputs from a few linear cuts
+    rng = np.random.RandomState(seed)
+    X = rng.uniform(-1, 1, (n, inputs)).astype(np.float32)
+    W = np.random.RandomState(0).uniform(-1, 1, (inputs, outputs))
+    Y = np.where(X @ W > 0, 0.5, -0.5).astype(np.float32)
+    return X, Y
+
+
+def writeText(filename: str, train: tuple, test: tuple = None):
+    # a data file in the CMU text format, continuous inputs and binary
+    # outputs; the inputs are rounded to what the text holds
+    X, Y = train
+    with open(filename, 'w') as hFile:
+        hFile.write('$SETUP\n\nPROTOCOL: IO;\nOFFSET: 0;\n')
+        hFile.write(
+            'INPUTS: %d;\nOUTPUTS: %d;\n\n' % (X.shape[1], Y.shape[1])
+        )
+        for i in range(X.shape[1]):
+            hFile.write('IN [%d]: CONT {-1.0..1.0};\n' % (i + 1))
+        for i in range(Y.shape[1]):
+            hFile.write('OUT [%d]: BINARY;\n' % (i + 1))
+        for name, data in (('TRAIN', train), ('TEST', test)):
+            if data is None:
+                continue
+            hFile.write('\n$%s\n\n' % name)
+            for x, y in zip(*data):
+                hFile.write('%s => %s;\n' % (
+                    ', '.join('%.6f' % v for v in x),
+                    ', '.join('+' if v > 0 else '-' for v in y)
+                ))
+
+
+def readResults(filename: str) -> np.array:
+    # the actual outputs, in parentheses, of a test results file
+    with open(filename) as hFile:
+        return np.array([
+            [float(v) for v in re.findall(r'\(([-\d.]+)\)', line)]
+            for line in hFile if '=>' in line
+        ])
+
+
+def readNet(filename: str) -> list:
+    # a weight file, less the comment line with the time it was saved
+    with open(filename) as hFile:
+        return [line for line in hFile if not line.startswith('#')]
+
+
+def runCascor(*args, cwd: str, env: dict = None) -> str:
+    # cascor falls back on asking for a data file it can't read, so stdin
+    # is closed and a hung run is cut short; 'env' is added to the
+    # environment
+    return subprocess.run(
+        [os.path.abspath(CASCOR_BIN)] + list(args), cwd=cwd,
+        env=dict(os.environ, **env) if env else None,
+        stdin=subprocess.DEVNULL, stdout=subprocess.PIPE,
+        stderr=subprocess.STDOUT, timeout=300, universal_newlines=True
+    ).stdout
+
+
+class CascorTestCase(unittest.TestCase):
+    def setUp(self):
+        self.dir = tempfile.mkdtemp(prefix='cascor')
+
+    def tearDown(self):
+        shutil.rmtree(self.dir)
+
+    def path(self, name: str) -> str:
+        return os.path.join(self.dir, name)
+
+    def writeConfig(self, name: str, text: str = TRAIN_CFG) -> str:
+        with open(self.path(name), 'w') as hFile:
+            hFile.write(text)
+        return self.path(name)
+
+
+@unittest.skipUnless(os.path.exists(CASCOR_BIN), "cascor is not built")
+class TestWeights(CascorTestCase):
+    def setUp(self):
+        super().setUp()
+        writeText(self.path('d.data'), makeSet(200), makeSet(50, seed=8))
+        self.cfg = self.writeConfig('d.cfg')
+
+    def train(self) -> str:
+        return runCascor(
+            '-s', self.path('n'), '-r', self.path('train.results'),
+            self.path('d.data'), self.cfg, cwd=self.dir
+        )
+
+    def test_round_trip(self):
+        # a saved network gives back exactly the outputs it was saved with
+        self.train()
+        runCascor(
+            '-p', self.path('n-1.net'), '-r', self.path('load.results'),
+            self.path('d.data'), self.cfg, cwd=self.dir
+        )
+        trained = readResults(self.path('train.results'))
+        loaded = readResults(self.path('load.results'))
+        self.assertEqual(trained.shape, (50, 2))
+        np.testing.assert_array_equal(trained, loaded)
+
+    def test_overwrite(self):
+        self.train()
+        with open(self.path('n-1.net'), 'w') as hFile:
+            hFile.write('stale')
+        self.assertIn('Overwriting weight file', self.train())
+        with open(self.path('n-1.net')) as hFile:
+            self.assertNotEqual(hFile.read(), 'stale')
+
+
+@unittest.skipUnless(os.path.exists(CASCOR_BIN), "cascor is not built")
+class TestThreads(CascorTestCase):
+    def test_thread_count(self):
+        # the candidate pool split among any number of threads trains the
+        # same network
+        writeText(self.path('d.data'), makeSet(300), makeSet(100, seed=8))
+        for threads in (1, 4):
+            runCascor(
+                '-s', self.path('n%d' % threads),
+                '-r', self.path('n%d.results' % threads),
+                self.path('d.data'),
+                self.writeConfig(
+                    'n%d.cfg' % threads, TRAIN_CFG + 'Nthreads\t%d\n' % threads
+                ), cwd=self.dir
+            )
+        self.assertEqual(
+            readNet(self.path('n1-1.net')), readNet(self.path('n4-1.net'))
+        )
+        results = readResults(self.path('n1.results'))
+        self.assertEqual(results.shape, (100, 2))
+        np.testing.assert_array_equal(
+            results, readResults(self.path('n4.results'))
+        )
+
+
+@unittest.skipUnless(os.path.exists(CASCOR_BIN), "cascor is not built")
+class TestKernels(CascorTestCase):
+    # a few epochs of each kind of training, before the sums done in
+    # another order have had time to lead training elsewhere
+    SHORT_CFG = (
+        'seed\t7\nmaxNewUnits\t1\noutEpochs\t5\ncandEpochs\t5\ntest\tTrue\n'
+    )
+
+    def setUp(self):
+        super().setUp()
+        writeText(self.path('d.data'), makeSet(300), makeSet(100, seed=8))
+        self.cfg = self.writeConfig('d.cfg')
+
+    def runOn(self, name: str, kernels: str, *args) -> tuple:
+        # the report and the test outputs of a run on the kernels asked for
+        # in CASCOR_KERNELS, or on the ones picked if 'kernels' is None
+        output = runCascor(
+            *args, '-r', self.path(name + '.results'), self.path('d.data'),
+            self.cfg, cwd=self.dir,
+            env={'CASCOR_KERNELS': kernels} if kernels else None
+        )
+        return output, readResults(self.path(name + '.results'))
+
+    def kernels(self, output: str) -> str:
+        return re.search(r'Kernels: (\S+)', output).group(1)
+
+    def test_scalar_same_as_vector(self):
+        # the plain C kernels and the vector ones the processor was found
+        # to run train and run the same network, but for rounding
+        self.cfg = self.writeConfig('short.cfg', self.SHORT_CFG)
+        vector, vectorOut = self.runOn('vector', None, '-s', self.path('n'))
+        scalar, scalarOut = self.runOn('scalar', 'scalar')
+        self.assertEqual(self.kernels(scalar), 'Scalar')
+        self.assertEqual(vectorOut.shape, (100, 2))
+        np.testing.assert_allclose(vectorOut, scalarOut, atol=1e-4)
+
+        net = ('-p', self.path('n-1.net'))
+        vector, vectorOut = self.runOn('vector', None, *net)
+        scalar, scalarOut = self.runOn('scalar', 'scalar', *net)
+        np.testing.assert_allclose(vectorOut, scalarOut, atol=1e-5)
+
+    def test_unknown_value(self):
+        # an unknown value is reported and the kernels are picked as usual
+        runCascor('-s', self.path('n'), self.path('d.data'), self.cfg,
+                  cwd=self.dir)
+        net = ('-p', self.path('n-1.net'))
+        picked, pickedOut = self.runOn('picked', None, *net)
+        bogus, bogusOut = self.runOn('bogus', 'bogus', *net)
+        self.assertIn("Unknown CASCOR_KERNELS value 'bogus'", bogus)
+        self.assertEqual(self.kernels(picked), self.kernels(bogus))
+        np.testing.assert_array_equal(pickedOut, bogusOut)
+
+
+@unittest.skipUnless(
+    os.path.exists(CASCOR_BIN) and os.path.exists(CMU2BIN_BIN),
+    "cascor is not built"
+)
+class TestBinaryData(CascorTestCase):
+    def setUp(self):
+        super().setUp()
+        self.test = makeSet(50, seed=8)
+        writeText(self.path('d.data'), makeSet(200), self.test)
+        subprocess.run(
+            [CMU2BIN_BIN, self.path('d.data'), self.path('d.bin')],
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL, check=True
+        )
+        self.cfg = self.writeConfig('d.cfg')
+
+    def results(self, args: list, data: str) -> np.array:
+        results = self.path('%s.results' % len(os.listdir(self.dir)))
+        runCascor(
+            *args, '-r', results, self.path(data), self.cfg, cwd=self.dir
+        )
+        return readResults(results)
+
+    def test_write_read(self):
+        from divanon.dblink.cmu_wrapper import CMUWrapper
+        wrapper = CMUWrapper()
+        X, Y = makeSet(37, inputs=5, outputs=3)
+        with open(self.path('w.data'), 'wb') as hFile:
+            wrapper._writeBinary(hFile, [(X, Y), None, self.test])
+        X2, Y2 = wrapper._readTrainSet(self.path('w.data'))
+        np.testing.assert_array_equal(X, X2)
+        np.testing.assert_array_equal(Y, Y2)
+
+    def test_cmu2bin_same_as_text(self):
+        # the text parsed and the binary file mapped give the same network
+        # and the same outputs
+        text = self.results(['-s', self.path('t')], 'd.data')
+        binary = self.results(['-s', self.path('b')], 'd.bin')
+        self.assertEqual(text.shape, (50, 2))
+        np.testing.assert_array_equal(text, binary)
+        np.testing.assert_array_equal(
+            text, self.results(['-p', self.path('t-1.net')], 'd.bin')
+        )
+
+    def test_wrapper_file_same_as_text(self):
+        from divanon.dblink.cmu_wrapper import CMUWrapper
+        wrapper = CMUWrapper()
+        text = self.results(['-s', self.path('t')], 'd.data')
+        # the training set as cascor parsed it, with the test set rounded
+        # the way the text has it
+        X, Y = wrapper._readTrainSet(self.path('d.bin'))
+        XT = np.array(
+            [[float('%.6f' % v) for v in x] for x in self.test[0]], np.float32
+        )
+        with open(self.path('w.data'), 'wb') as hFile:
+            wrapper._writeBinary(hFile, [(X, Y), None, (XT, self.test[1])])
+        np.testing.assert_array_equal(
+            text, self.results(['-p', self.path('t-1.net')], 'w.data')
+        )
+
+
+@unittest.skipUnless(
+    os.path.exists(CASCOR_BIN) and os.path.exists(CASCOR_LIB),
+    "cascor is not built"
+)
+class TestCascorNet(CascorTestCase):
+    def setUp(self):
+        super().setUp()
+        from divanon.dblink.cascor_lib import CascorNet
+        self.net = CascorNet()
+        self.train = makeSet(300)
+        self.test = makeSet(100, seed=8)
+        self.net.setData(*self.train)
+        self.net.setParm('seed', 7)
+        self.net.setParm('maxNewUnits', 3)
+
+    def tearDown(self):
+        self.net.free()
+        super().tearDown()
+
+    def test_train_predict(self):
+        self.net.train()
+        P = self.net.predict(self.test[0])
+        self.assertEqual(P.shape, (100, 2))
+        self.assertGreater(np.mean((P > 0) == (self.test[1] > 0)), 0.8)
+        # the same points give the same outputs, one at a time or together
+        np.testing.assert_array_equal(
+            P[:5], self.net.predict(self.test[0][:5])
+        )
+
+    def test_load_net(self):
+        # a network the program saved gives the outputs it gives there
+        X, Y = self.train
+        writeText(self.path('d.data'), (X, Y), self.test)
+        self.writeConfig('d.cfg')
+        runCascor(
+            '-s', self.path('n'), '-r', self.path('d.results'),
+            self.path('d.data'), self.path('d.cfg'), cwd=self.dir
+        )
+        XT = np.array(
+            [[float('%.6f' % v) for v in x] for x in self.test[0]], np.float32
+        )
+        X = np.array([[float('%.6f' % v) for v in x] for x in X], np.float32)
+        self.net.setData(X, Y)
+        self.net.loadNet(self.path('n-1.net'))
+        np.testing.assert_allclose(
+            self.net.predict(XT), readResults(self.path('d.results')),
+            atol=1e-6
+        )
+        # and it can be trained on from there
+        self.net.train()
+        self.assertEqual(self.net.predict(XT).shape, (100, 2))
+
+    def test_bad_calls(self):
+        with self.assertRaises(RuntimeError):
+            self.net.predict(self.test[0])
+        self.net.train()
+        with self.assertRaises(ValueError):
+            self.net.predict(self.test[0][:, :5])
+        with self.assertRaises(ValueError):
+            self.net.predict(self.test[0][0])
+        self.assertEqual(self.net.predict(self.test[0][:0]).shape, (0, 2))
+        with self.assertRaises(ValueError):
+            self.net.setParm('seed', '7' * 1000)
+        with self.assertRaises(ValueError):
+            self.net.setParm('noSuchParameter', 1)
+
+
+@unittest.skipUnless(os.path.exists(CASCOR_BIN), "cascor is not built")
+class TestTrials(CascorTestCase):
+    def setUp(self):
+        super().setUp()
+        writeText(self.path('d.data'), makeSet(300), makeSet(100, seed=8))
+
+    def runTrials(self, name: str, threads: int) -> str:
+        # the run results of 4 trials, less the time they took
+        output = runCascor(
+            '-s', self.path(name), '-r', self.path(name + '.results'),
+            self.path('d.data'),
+            self.writeConfig(
+                name + '.cfg',
+                TRAIN_CFG + 'Ntrials\t4\ntrialThreads\t%d\n' % threads
+            ), cwd=self.dir
+        )
+        summary = output[output.index('Run Results'):output.index('Phase')]
+        return re.sub(r'.*Run time:.*\n', '', summary)
+
+    def test_trial_threads(self):
+        # trials run side by side train the networks they train one after
+        # another, and the same one is kept
+        summary = self.runTrials('t1', 1)
+        self.assertIn('Network kept: trial', summary)
+        self.assertEqual(summary, self.runTrials('t3', 3))
+        for n in range(1, 5):
+            self.assertEqual(
+                readNet(self.path('t1-%d.net' % n)),
+                readNet(self.path('t3-%d.net' % n))
+            )
+        np.testing.assert_array_equal(
+            readResults(self.path('t1.results')),
+            readResults(self.path('t3.results'))
+        )
+
+    def test_rerun_trial(self):
+        # trial n runs with seed + n - 1, so it can be run again on its own
+        self.runTrials('t', 3)
+        runCascor(
+            '-s', self.path('r'), self.path('d.data'),
+            self.writeConfig('r.cfg', TRAIN_CFG.replace('seed\t7', 'seed\t9')),
+            cwd=self.dir
+        )
+        self.assertEqual(
+            readNet(self.path('r-1.net')), readNet(self.path('t-3.net'))
+        )
+
+
+@unittest.skipUnless(os.path.exists(CASCOR_BIN), "cascor is not built")
+class TestCacheTypes(CascorTestCase):
+    # one hidden unit, trained a few epochs, so that the runs only part
+    # by the rounding of its values in a Packed cache
+    CFG = (
+        'seed\t7\nmaxNewUnits\t1\noutEpochs\t5\ncandEpochs\t5\n'
+        'test\tTrue\nsaveCache\tTrue\n'
+    )
+
+    def setUp(self):
+        super().setUp()
+        writeText(self.path('d.data'), makeSet(300), makeSet(100, seed=8))
+
+    def train(self, name: str, parms: str, env: dict = None) -> str:
+        return runCascor(
+            '-s', self.path(name), '-r', self.path(name + '.results'),
+            self.path('d.data'),
+            self.writeConfig(name + '.cfg', self.CFG + parms), cwd=self.dir,
+            env=env
+        )
+
+    def cache(self, name: str) -> np.array:
+        # the hidden unit values of a saved cache, after its header
+        return np.fromfile(self.path(name + '-1.cache'), np.float32,
+                           offset=24)
+
+    def test_types(self):
+        for cacheType in ('Full', 'Packed'):
+            self.train(cacheType, 'cacheType\t%s\n' % cacheType)
+            disk = cacheType + 'Disk'
+            report = self.train(
+                disk, 'cacheType\t%s\ncacheOnDisk\tTrue\n' % cacheType,
+                {'TMPDIR': self.dir}
+            )
+            self.assertIn('Cache type: %s\tCache on disk: On' % cacheType,
+                          report)
+            # a cache on disk is the same cache
+            np.testing.assert_array_equal(
+                readResults(self.path(cacheType + '.results')),
+                readResults(self.path(disk + '.results'))
+            )
+            np.testing.assert_array_equal(
+                self.cache(cacheType), self.cache(disk)
+            )
+
+        # a Packed cache keeps the hidden units to bfloat16
+        full = self.cache('Full')
+        self.assertEqual(full.shape, (300,))
+        np.testing.assert_allclose(self.cache('Packed'), full, rtol=2 ** -8)
+        results = readResults(self.path('Full.results'))
+        self.assertEqual(results.shape, (100, 2))
+        np.testing.assert_allclose(
+            readResults(self.path('Packed.results')), results, atol=1e-3
+        )
+
+    def test_no_room_on_disk(self):
+        # with nowhere to put a cache on disk, nor a Packed one, training
+        # goes on without one
+        report = self.train(
+            'nowhere', 'cacheOnDisk\tTrue\n',
+            {'TMPDIR': self.path('nowhere')}
+        )
+        self.assertIn('No room for a Full cache on disk', report)
+        self.assertIn('No room for a Packed cache on disk', report)
+        self.assertIn('Shutting cache down', report)
+        self.train('none', 'useCache\tFalse\n')
+        np.testing.assert_array_equal(
+            readResults(self.path('none.results')),
+            readResults(self.path('nowhere.results'))
+        )
+
+
+@unittest.skipUnless(os.path.exists(BENCH_BIN), "benchmark is not built")
+class TestBenchmark(CascorTestCase):
+    PHASES = ['train_outputs', 'train_cand', 'recompute_cache',
+              'validation_epoch', 'test_epoch']
+    WORKLOADS = ['xor.data', 'spirals', 'synth-50x4x1']
+
+    def bench(self, *args) -> str:
+        # the benchmark on its own workloads and a small synthetic one
+        output = self.path('bench.out')
+        subprocess.run(
+            [os.path.abspath(BENCH_BIN), '-s', '50,4,1',
+             '-x', os.path.abspath(CASCOR_DIR + '/xor.data'), '-o', output]
+            + list(args), cwd=self.dir, stdin=subprocess.DEVNULL,
+            stdout=subprocess.DEVNULL, stderr=subprocess.DEVNULL,
+            timeout=300, check=True
+        )
+        with open(output) as hFile:
+            return hFile.read()
+
+    def test_json(self):
+        workloads = json.loads(self.bench())['workloads']
+        self.assertEqual([w['name'] for w in workloads], self.WORKLOADS)
+        for workload in workloads:
+            phases = workload['phases']
+            self.assertEqual(sorted(phases), sorted(self.PHASES))
+            self.assertEqual(
+                workload['crossings'],
+                sum(phase['crossings'] for phase in phases.values())
+            )
+        self.assertEqual(
+            [workloads[2][k] for k in ('patterns', 'inputs', 'outputs')],
+            [50, 4, 1]
+        )
+
+    def test_csv(self):
+        rows = list(csv.DictReader(self.bench('-f', 'csv').splitlines()))
+        self.assertEqual(
+            list(rows[0]), ['workload', 'patterns', 'inputs', 'outputs',
+                            'phase', 'calls', 'seconds', 'crossings']
+        )
+        for name in self.WORKLOADS:
+            phases = [row for row in rows if row['workload'] == name]
+            self.assertEqual([row['phase'] for row in phases],
+                             self.PHASES + ['total'])
+            self.assertEqual(
+                int(phases[-1]['crossings']),
+                sum(int(row['crossings']) for row in phases[:-1])
+            )
+        self.assertEqual(len(rows), 3 * 6)
+
+
+@unittest.skipUnless(os.path.exists(CASCOR_BIN), "cascor is not built")
+class TestServer(CascorTestCase):
+    def setUp(self):
+        super().setUp()
+        self.test = makeSet(100, seed=8)
+        writeText(self.path('d.data'), makeSet(200), self.test)
+        # a network wide enough for MAX_SERVE_PTS points to go over
+        # MAX_SERVE_BYTES
+        writeText(self.path('w.data'), makeSet(20, inputs=80))
+        self.writeConfig('d.cfg')
+        self.writeConfig('w.cfg', 'seed\t7\nmaxNewUnits\t0\n')
+        runCascor(
+            '-s', self.path('d'), '-r', self.path('d.results'),
+            self.path('d.data'), self.path('d.cfg'), cwd=self.dir
+        )
+        runCascor(
+            '-s', self.path('w'), self.path('w.data'), self.path('w.cfg'),
+            cwd=self.dir
+        )
+        self.sock = self.path('s.sock')
+        self.server = subprocess.Popen(
+            [os.path.abspath(CASCOR_BIN), '-S', self.sock,
+             self.path('d.data'), self.path('d-1.net'),
+             self.path('w.data'), self.path('w-1.net')],
+            stdin=subprocess.DEVNULL, stdout=subprocess.DEVNULL,
+            stderr=subprocess.DEVNULL, cwd=self.dir
+        )
+        for _ in range(100):
+            if os.path.exists(self.sock):
+                break
+            time.sleep(0.05)
+        self.XT = np.array(
+            [[float('%.6f' % v) for v in x] for x in self.test[0]], np.float32
+        )
+        self.ref = readResults(self.path('d.results'))
+
+    def tearDown(self):
+        self.server.kill()
+        self.server.wait()
+        super().tearDown()
+
+    def client(self):
+        from divanon.dblink.cascor_client import CascorClient
+        return CascorClient(self.sock)
+
+    def raw(self, net: int, pts: int) -> tuple:
+        # the reply to a bare request header
+        s = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        s.connect(self.sock)
+        s.sendall(struct.pack('=2i', net, pts))
+        reply = struct.unpack('=4i', s.recv(16))
+        s.close()
+        return reply
+
+    def test_predict(self):
+        client = self.client()
+        self.assertEqual(client.sizes(), (8, 2))
+        self.assertEqual(client.sizes(1), (80, 2))
+        np.testing.assert_allclose(client.predict(self.XT), self.ref,
+                                   atol=1e-6)
+        self.assertEqual(client.predict(self.XT[:0]).shape, (0, 2))
+
+    def test_batched_clients(self):
+        # requests of clients running side by side are batched together,
+        # and each still gets its own outputs back
+        errors = []
+
+        def work(i: int):
+            client = self.client()
+            for k in range(20):
+                at = (i * 7 + k) % 90
+                errors.append(np.abs(
+                    client.predict(self.XT[at:at + 10]) -
+                    self.ref[at:at + 10]
+                ).max())
+
+        threads = [threading.Thread(target=work, args=(i,)) for i in range(8)]
+        [thread.start() for thread in threads]
+        [thread.join() for thread in threads]
+        self.assertEqual(len(errors), 160)
+        self.assertLess(max(errors), 1e-6)
+
+    def test_bad_net(self):
+        with self.assertRaisesRegex(ValueError, 'no such network'):
+            self.client().predict(self.XT, net=2)
+        self.assertEqual(self.raw(-1, 0)[0], 1)
+        # the server carries on with the other clients
+        self.assertEqual(self.client().sizes(), (8, 2))
+
+    def test_too_big(self):
+        # too many points, too many bytes of inputs, or nonsense
+        self.assertEqual(self.raw(0, (1 << 20) + 1), (2, 0, 0, 0))
+        self.assertEqual(self.raw(1, 1 << 20), (2, 0, 0, 0))
+        self.assertEqual(self.raw(0, -1), (2, 0, 0, 0))
+        with self.assertRaisesRegex(ValueError, 'too many points'):
+            self.client().predict(np.zeros(((1 << 20) + 1, 8), np.float32))
+        self.assertEqual(self.client().sizes(1), (80, 2))
+
+
+@unittest.skipUnless(os.path.exists(CASCOR_BIN), "cascor is not built")
+class TestContinue(CascorTestCase):
+    CFG = 'seed\t7\nmaxNewUnits\t3\nsaveCache\tTrue\n'
+
+    def setUp(self):
+        super().setUp()
+        from divanon.dblink.cmu_wrapper import CMUWrapper
+        self.wrapper = CMUWrapper()
+        X, Y = makeSet(300)
+        self.old = (X[:200], Y[:200].argmax(1))
+        self.new = (X[200:], Y[200:].argmax(1))
+        self.data = self.path('t.data')
+        self.wrapper.generateTrainSet(self.data, *self.old, 2)
+
+    def carryOn(self, netfile: str, name: str, cfg: str = CFG) -> str:
+        # carry on training with the program, for its report
+        return runCascor(
+            '-C', netfile, '-s', self.path(name), self.data,
+            self.writeConfig(name + '.cfg', cfg), cwd=self.dir
+        )
+
+    def trueError(self, report: str) -> str:
+        return re.findall(r'Training true error: +([-\d.]+)', report)[-1]
+
+    def test_cache_reload(self):
+        for cacheType in ('Full', 'Packed'):
+            cfg = self.CFG + 'cacheType\t%s\n' % cacheType
+            runCascor('-s', self.path('n'), self.data,
+                      self.writeConfig('n.cfg', cfg), cwd=self.dir)
+            self.assertTrue(os.path.exists(self.path('n-1.cache')))
+            self.wrapper.appendTrainSet(self.data, *self.new, 2)
+
+            cached = self.carryOn(self.path('n-1.net'), 'c', cfg)
+            self.assertIn('Read cache for 200 patterns', cached)
+            os.remove(self.path('n-1.cache'))
+            fresh = self.carryOn(self.path('n-1.net'), 'f', cfg)
+            self.assertNotIn('Read cache', fresh)
+            self.assertEqual(self.trueError(cached), self.trueError(fresh))
+            self.wrapper.generateTrainSet(self.data, *self.old, 2)
+
+    def test_stale_cache(self):
+        runCascor('-s', self.path('n'), self.data,
+                  self.writeConfig('n.cfg', self.CFG), cwd=self.dir)
+        # the same number of patterns, but not the ones the cache was
+        # saved for
+        X, y = self.old
+        X = X.copy()
+        X[150, 3] += 0.25
+        self.wrapper.generateTrainSet(self.data, X, y, 2)
+        self.wrapper.appendTrainSet(self.data, *self.new, 2)
+        report = self.carryOn(self.path('n-1.net'), 'c')
+        self.assertIn('does not go with', report)
+        self.assertNotIn('Read cache', report)
+        self.assertTrue(os.path.exists(self.path('c-1.net')))
+
+    def test_test_set(self):
+        # the test epoch at the end of training leaves the cache that is
+        # saved alone
+        writeText(self.path('d.data'), makeSet(300), makeSet(100, seed=8))
+        for test in ('False', 'True'):
+            cfg = self.CFG + 'test\t%s\n' % test
+            runCascor(
+                '-s', self.path(test), self.path('d.data'),
+                self.writeConfig(test + '.cfg', cfg), cwd=self.dir
+            )
+        with open(self.path('False-1.cache'), 'rb') as hFile:
+            untested = hFile.read()
+        with open(self.path('True-1.cache'), 'rb') as hFile:
+            self.assertEqual(untested, hFile.read())
+
+    def test_wrapper(self):
+        netfile = self.wrapper.trainByTrainFile(
+            self.data, self.path('n'), False
+        )
+        self.assertEqual(netfile, self.path('n-1.net'))
+        self.assertTrue(os.path.exists(self.path('n-1.cache')))
+        self.wrapper.appendTrainSet(self.data, *self.new, 2)
+        X, Y = self.wrapper._readTrainSet(self.data)
+        self.assertEqual(X.shape, (300, 8))
+
+        # carried on in place, under the network's own name
+        self.assertEqual(
+            self.wrapper.continueByTrainFile(
+                self.data, netfile, self.path('n'), False
+            ), netfile
+        )
+        self.assertEqual(
+            sorted(os.listdir(self.dir)), ['n-1.cache', 'n-1.net', 't.data']
+        )
+        # and the cache saved covers the appended patterns too; the
+        # shipped configuration allows for many more units than CFG
+        self.assertIn(
+            'Read cache for 300 patterns',
+            self.carryOn(netfile, 'c', self.CFG.replace('3', '100'))
+        )
+
+
+if __name__ == '__main__':
+    unittest.main()